@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -22,20 +22,31 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-CONFIG += c++11
+# Qt 6 requires C++17
+greaterThan(QT_MAJOR_VERSION, 5) {
+    CONFIG += c++17
+} else {
+    CONFIG += c++11
+}
 
 SOURCES += \
+        enhancedfooter.cpp \
         enhancedheader.cpp \
         enhancedstandarditemmodel.cpp \
         enhancedtableview.cpp \
         main.cpp \
-        mainwindow.cpp
+        mainwindow.cpp \
+        quickfindbar.cpp \
+        tableexporter.cpp
 
 HEADERS += \
+        enhancedfooter.h \
         enhancedheader.h \
         enhancedstandarditemmodel.h \
         enhancedtableview.h \
-        mainwindow.h
+        mainwindow.h \
+        quickfindbar.h \
+        tableexporter.h
 
 FORMS += \
         mainwindow.ui
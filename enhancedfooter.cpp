@@ -0,0 +1,445 @@
+#include "enhancedfooter.h"
+#include <QPainter>
+#include <QStyleOption>
+#include <QTimer>
+#include <QtConcurrent>
+#include <QtMath>
+#include <QtDebug>
+
+EnhancedFooter::EnhancedFooter(QTableView *view):
+    QWidget (view), view(view), header(view->horizontalHeader())
+{
+    connect(header, &QHeaderView::sectionResized, this, [ = ]() {
+        update();
+    });
+    connect(header, &QHeaderView::sectionMoved, this, [ = ]() {
+        update();
+    });
+    connect(header, &QHeaderView::geometriesChanged, this, [ = ]() {
+        update();
+    });
+}
+
+void EnhancedFooter::setModel(QAbstractItemModel *model)
+{
+    if(this->model != nullptr) {
+        disconnect(this->model, nullptr, this, nullptr);
+    }
+    this->model = model;
+    visibleRows = QBitArray();
+
+    if(model != nullptr) {
+        connect(model, &QAbstractItemModel::dataChanged, this,
+                &EnhancedFooter::updateValues);
+        connect(model, &QAbstractItemModel::rowsInserted, this,
+                &EnhancedFooter::insertValues);
+        connect(model, &QAbstractItemModel::rowsRemoved, this,
+                &EnhancedFooter::removeValues);
+        connect(model, &QAbstractItemModel::columnsInserted, this,
+                &EnhancedFooter::scheduleRebuild);
+        connect(model, &QAbstractItemModel::columnsRemoved, this,
+                &EnhancedFooter::scheduleRebuild);
+        connect(model, &QAbstractItemModel::layoutChanged, this,
+                &EnhancedFooter::scheduleRebuild);
+        connect(model, &QAbstractItemModel::modelReset, this,
+                &EnhancedFooter::scheduleRebuild);
+    }
+    rebuild();
+}
+
+void EnhancedFooter::setAggregates(Aggregates aggregates)
+{
+    this->aggregates = aggregates;
+    updateGeometry();
+    update();
+}
+
+// 过滤结果变化时只重新计算可见性发生变化的块
+void EnhancedFooter::setVisibleRows(const QBitArray &rows)
+{
+    if(rows.size() != visibleRows.size() || rows.size() != rowCount) {
+        dirtyBlocks.fill(true);
+    } else {
+        QBitArray diff = rows ^ visibleRows;
+        const char *bits = diff.bits();
+        int bytes = (diff.size() + 7) / 8;
+        const int blockBytes = blockSize / 8;
+        for(int i = 0; i < bytes; i++) {
+            if(bits[i] != 0) {
+                dirtyBlocks.setBit(i / blockBytes);
+                i = (i / blockBytes + 1) * blockBytes - 1;
+            }
+        }
+    }
+    visibleRows = rows;
+    if(!isHidden()) {
+        recompute();
+    }
+}
+
+QSize EnhancedFooter::sizeHint() const
+{
+    int lines = 0;
+    for(int flag = Count; flag <= Average; flag <<= 1) {
+        if(aggregates.testFlag(static_cast<Aggregate>(flag))) {
+            lines++;
+        }
+    }
+    return QSize(QWidget::sizeHint().width(), lines * fontMetrics().height() + 6);
+}
+
+// 只在底栏自身显示或隐藏时重建，祖先窗口重新显示不会触发；隐藏时rebuild会清空缓存
+void EnhancedFooter::setVisible(bool visible)
+{
+    bool changed = visible == isHidden();
+    QWidget::setVisible(visible);
+    if(changed) {
+        rebuild();
+    }
+}
+
+void EnhancedFooter::scheduleRebuild()
+{
+    if(!rebuildPending) {
+        rebuildPending = true;
+        QTimer::singleShot(0, this, &EnhancedFooter::rebuild);
+    }
+}
+
+void EnhancedFooter::updateValues(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(isHidden() || rebuildPending || !topLeft.isValid() || topLeft.parent().isValid()) {
+        return;
+    }
+
+    int lastRow = qMin(bottomRight.row(), rowCount - 1);
+    int lastColumn = qMin(bottomRight.column(), values.size() - 1);
+    for(int j = topLeft.column(); j <= lastColumn; j++) {
+        QVector<double> &column = values[j];
+        for(int i = topLeft.row(); i <= lastRow; i++) {
+            bool ok = false;
+            double value = model->data(model->index(i, j)).toDouble(&ok);
+            if(column.isEmpty()) {
+                // 非数值列出现了数值，整列重新识别
+                if(ok) {
+                    scheduleRebuild();
+                    return;
+                }
+                continue;
+            }
+            column[i] = ok ? value : qQNaN();
+        }
+    }
+    markDirty(topLeft.row(), lastRow);
+    scheduleRecompute();
+}
+
+// 插入行后其后的行号整体后移，只有插入位置所在及之后的块需要重新计算
+void EnhancedFooter::insertValues(const QModelIndex &parent, int first, int last)
+{
+    if(isHidden() || rebuildPending || parent.isValid()) {
+        return;
+    }
+
+    int count = last - first + 1;
+    for(int j = 0; j < values.size(); j++) {
+        QVector<double> &column = values[j];
+        if(column.isEmpty()) {
+            // 非数值列出现了数值，整列重新识别
+            for(int i = first; i <= last; i++) {
+                bool ok = false;
+                model->data(model->index(i, j)).toDouble(&ok);
+                if(ok) {
+                    scheduleRebuild();
+                    return;
+                }
+            }
+            continue;
+        }
+        column.insert(first, count, qQNaN());
+        for(int i = first; i <= last; i++) {
+            bool ok = false;
+            double value = model->data(model->index(i, j)).toDouble(&ok);
+            if(ok) {
+                column[i] = value;
+            }
+        }
+    }
+
+    // 视图已先于底栏处理插入，新行的隐藏状态直接从视图读取
+    QBitArray rows(rowCount + count);
+    for(int i = 0; i < first; i++) {
+        rows.setBit(i, visibleRows.testBit(i));
+    }
+    for(int i = first; i <= last; i++) {
+        rows.setBit(i, !view->isRowHidden(i));
+    }
+    for(int i = first; i < rowCount; i++) {
+        rows.setBit(i + count, visibleRows.testBit(i));
+    }
+    visibleRows = rows;
+    rowCount += count;
+
+    resizeBlocks();
+    markDirty(first, rowCount - 1);
+    scheduleRecompute();
+}
+
+void EnhancedFooter::removeValues(const QModelIndex &parent, int first, int last)
+{
+    if(isHidden() || rebuildPending || parent.isValid()) {
+        return;
+    }
+
+    int count = last - first + 1;
+    for(int j = 0; j < values.size(); j++) {
+        QVector<double> &column = values[j];
+        if(!column.isEmpty()) {
+            column.remove(first, count);
+        }
+    }
+
+    QBitArray rows(rowCount - count);
+    for(int i = 0; i < first; i++) {
+        rows.setBit(i, visibleRows.testBit(i));
+    }
+    for(int i = last + 1; i < rowCount; i++) {
+        rows.setBit(i - count, visibleRows.testBit(i));
+    }
+    visibleRows = rows;
+    rowCount -= count;
+
+    resizeBlocks();
+    markDirty(first, qMax(first, rowCount - 1));
+    scheduleRecompute();
+}
+
+void EnhancedFooter::rebuild()
+{
+    rebuildPending = false;
+    values.clear();
+    partials.clear();
+    totals.clear();
+    dirtyBlocks.clear();
+    // 隐藏时不维护缓存，显示时再重建
+    if(isHidden()) {
+        rowCount = 0;
+        return;
+    }
+
+    rowCount = model != nullptr ? model->rowCount() : 0;
+    // 增删行或排序后行号已变化，按视图当前的隐藏状态重建可见行
+    visibleRows = QBitArray(rowCount);
+    for(int i = 0; i < rowCount; i++) {
+        visibleRows.setBit(i, !view->isRowHidden(i));
+    }
+    int colCount = model != nullptr ? model->columnCount() : 0;
+    int blockCount = (rowCount + blockSize - 1) / blockSize;
+    values.resize(colCount);
+
+    /*
+     * 模型只能在GUI线程读取，字符串到数值的转换和分块聚合并行进行。
+     * 前64个非空单元格都不是数值的列视为非数值列
+    */
+    for(int j = 0; j < colCount; j++) {
+        QVector<QVariant> cells(rowCount);
+        int textCells = 0;
+        bool numeric = false;
+        for(int i = 0; i < rowCount; i++) {
+            cells[i] = model->data(model->index(i, j));
+            if(!numeric && textCells < 64 && !cells[i].toString().isEmpty()) {
+                cells.at(i).toDouble(&numeric);
+                textCells++;
+                if(!numeric && textCells == 64) {
+                    break;
+                }
+            }
+        }
+        if(!numeric) {
+            continue;
+        }
+
+        QVector<double> &column = values[j];
+        column.resize(rowCount);
+        double *out = column.data();
+        const QVariant *in = cells.constData();
+        QVector<int> blocks;
+        for(int b = 0; b < blockCount; b++) {
+            blocks.append(b);
+        }
+        QtConcurrent::blockingMap(blocks, [ = ](int &block) {
+            int end = qMin((block + 1) * blockSize, rowCount);
+            for(int i = block * blockSize; i < end; i++) {
+                bool ok = false;
+                double value = in[i].toDouble(&ok);
+                out[i] = ok ? value : qQNaN();
+            }
+        });
+    }
+
+    partials = QVector<Partial>(blockCount * colCount);
+    dirtyBlocks = QBitArray(blockCount, true);
+    recompute();
+}
+
+void EnhancedFooter::recompute()
+{
+    recomputePending = false;
+    QVector<int> blocks;
+    int blockCount = dirtyBlocks.size();
+    for(int b = 0; b < blockCount; b++) {
+        if(dirtyBlocks.testBit(b)) {
+            blocks.append(b);
+        }
+    }
+    computeBlocks(blocks);
+    dirtyBlocks.fill(false);
+
+    int colCount = values.size();
+    totals = QVector<Partial>(colCount);
+    for(int b = 0; b < blockCount; b++) {
+        const Partial *block = partials.constData() + b * colCount;
+        for(int j = 0; j < colCount; j++) {
+            const Partial &p = block[j];
+            Partial &t = totals[j];
+            if(p.count == 0) {
+                continue;
+            }
+            t.min = t.count == 0 ? p.min : qMin(t.min, p.min);
+            t.max = t.count == 0 ? p.max : qMax(t.max, p.max);
+            t.count += p.count;
+            t.sum += p.sum;
+        }
+    }
+    update();
+}
+
+// 行数变化后调整块数，新增的块标记为脏
+void EnhancedFooter::resizeBlocks()
+{
+    int blockCount = (rowCount + blockSize - 1) / blockSize;
+    int oldCount = dirtyBlocks.size();
+    partials.resize(blockCount * values.size());
+    dirtyBlocks.resize(blockCount);
+    for(int b = oldCount; b < blockCount; b++) {
+        dirtyBlocks.setBit(b);
+    }
+}
+
+void EnhancedFooter::scheduleRecompute()
+{
+    if(!recomputePending) {
+        recomputePending = true;
+        QTimer::singleShot(0, this, &EnhancedFooter::recompute);
+    }
+}
+
+void EnhancedFooter::markDirty(int firstRow, int lastRow)
+{
+    for(int b = firstRow / blockSize; b <= lastRow / blockSize && b < dirtyBlocks.size(); b++) {
+        dirtyBlocks.setBit(b);
+    }
+}
+
+void EnhancedFooter::computeBlocks(QVector<int> blocks)
+{
+    if(blocks.isEmpty()) {
+        return;
+    }
+
+    Partial *out = partials.data();
+    int colCount = values.size();
+    if(blocks.size() <= 4) {
+        for(int block : blocks) {
+            computeBlock(block, out + block * colCount);
+        }
+        return;
+    }
+    QtConcurrent::blockingMap(blocks, [ = ](int &block) {
+        computeBlock(block, out + block * colCount);
+    });
+}
+
+void EnhancedFooter::computeBlock(int block, Partial *out) const
+{
+    int start = block * blockSize;
+    int end = qMin(start + blockSize, rowCount);
+    int visibleCount = visibleRows.size();
+    int colCount = values.size();
+    for(int j = 0; j < colCount; j++) {
+        Partial p;
+        const QVector<double> &column = values.at(j);
+        if(!column.isEmpty()) {
+            const double *data = column.constData();
+            for(int i = start; i < end; i++) {
+                if((i < visibleCount && !visibleRows.testBit(i)) || qIsNaN(data[i])) {
+                    continue;
+                }
+                double value = data[i];
+                p.min = p.count == 0 ? value : qMin(p.min, value);
+                p.max = p.count == 0 ? value : qMax(p.max, value);
+                p.sum += value;
+                p.count++;
+            }
+        }
+        out[j] = p;
+    }
+}
+
+QString EnhancedFooter::sectionText(int column) const
+{
+    if(column < 0 || column >= values.size() || values.at(column).isEmpty()) {
+        return "";
+    }
+
+    const Partial &t = totals.at(column);
+    QStringList lines;
+    if(aggregates.testFlag(Count)) {
+        lines << QString("计数: %1").arg(t.count);
+    }
+    if(t.count > 0) {
+        if(aggregates.testFlag(Sum)) {
+            lines << QString("求和: %1").arg(t.sum, 0, 'g', 12);
+        }
+        if(aggregates.testFlag(Min)) {
+            lines << QString("最小: %1").arg(t.min, 0, 'g', 12);
+        }
+        if(aggregates.testFlag(Max)) {
+            lines << QString("最大: %1").arg(t.max, 0, 'g', 12);
+        }
+        if(aggregates.testFlag(Average)) {
+            lines << QString("平均: %1").arg(t.sum / t.count, 0, 'g', 12);
+        }
+    }
+    return lines.join("\n");
+}
+
+
+// 按表头的分区位置绘制，与表头样式保持一致
+void EnhancedFooter::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(this);
+    int count = header->count();
+    for(int visual = 0; visual < count; visual++) {
+        int logical = header->logicalIndex(visual);
+        if(header->isSectionHidden(logical)) {
+            continue;
+        }
+        QRect rect(header->sectionViewportPosition(logical), 0,
+                   header->sectionSize(logical), height());
+        if(rect.right() < 0 || rect.left() > width()) {
+            continue;
+        }
+
+        QStyleOptionHeader opt;
+        opt.initFrom(this);
+        opt.rect = rect;
+        opt.section = logical;
+        opt.orientation = Qt::Horizontal;
+        opt.position = QStyleOptionHeader::Middle;
+        style()->drawControl(QStyle::CE_HeaderSection, &opt, &painter, this);
+        painter.drawText(rect.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignVCenter,
+                         sectionText(logical));
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef ENHANCEDFOOTER_H
+#define ENHANCEDFOOTER_H
+
+#include <QWidget>
+#include <QTableView>
+#include <QBitArray>
+#include <QPointer>
+
+class EnhancedFooter: public QWidget
+{
+    Q_OBJECT
+public:
+    enum Aggregate {
+        Count = 0x01,
+        Sum = 0x02,
+        Min = 0x04,
+        Max = 0x08,
+        Average = 0x10,
+        AllAggregates = Count | Sum | Min | Max | Average
+    };
+    Q_DECLARE_FLAGS(Aggregates, Aggregate)
+
+    EnhancedFooter(QTableView *view);
+    void setModel(QAbstractItemModel *model);
+    void setAggregates(Aggregates aggregates);
+    void setVisibleRows(const QBitArray &rows);
+    QSize sizeHint() const override;
+    void setVisible(bool visible) override;
+
+private slots:
+    void scheduleRebuild();
+    void updateValues(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void insertValues(const QModelIndex &parent, int first, int last);
+    void removeValues(const QModelIndex &parent, int first, int last);
+    void rebuild();
+    void recompute();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    struct Partial {
+        qint64 count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+    };
+    static const int blockSize = 4096;
+
+    void resizeBlocks();
+    void scheduleRecompute();
+    void markDirty(int firstRow, int lastRow);
+    void computeBlocks(QVector<int> blocks);
+    void computeBlock(int block, Partial *out) const;
+    QString sectionText(int column) const;
+
+    QTableView *view;
+    QHeaderView *header;
+    QPointer<QAbstractItemModel> model;
+    Aggregates aggregates = AllAggregates;
+    QBitArray visibleRows;
+    QBitArray dirtyBlocks;
+    // 每列的数值缓存，非数值单元格为NaN，非数值列为空
+    QVector<QVector<double>> values;
+    // 按块存放的部分聚合，下标为 block * 列数 + 列
+    QVector<Partial> partials;
+    QVector<Partial> totals;
+    int rowCount = 0;
+    bool rebuildPending = false;
+    bool recomputePending = false;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(EnhancedFooter::Aggregates)
+
+#endif // ENHANCEDFOOTER_H
@@ -1,5 +1,6 @@
 #include "enhancedheader.h"
 #include <QLineEdit>
+#include <QCompleter>
 #include <QPainter>
 #include <QtDebug>
 
@@ -42,10 +43,41 @@ void EnhancedHeader::setFilterBoxes()
         connect(edit, &QLineEdit::textChanged, this, [ = ](QString filter) {
             emit this->filterChanged(i, filter);
         });
+        setFilterCompleter(edit, filterValues.value(i));
         editors.append(edit);
     }
 }
 
+// 为过滤框提供可选值下拉列表，传入空列表则取消
+void EnhancedHeader::setFilterValues(int logicalIndex, const QStringList &values)
+{
+    if(values.isEmpty()) {
+        filterValues.remove(logicalIndex);
+    } else {
+        filterValues.insert(logicalIndex, values);
+    }
+
+    if(logicalIndex >= 0 && logicalIndex < editors.count()) {
+        setFilterCompleter(editors[logicalIndex], values);
+    }
+}
+
+void EnhancedHeader::setFilterCompleter(QLineEdit *edit, const QStringList &values)
+{
+    QCompleter *old = edit->completer();
+    if(values.isEmpty()) {
+        edit->setCompleter(nullptr);
+    } else {
+        QCompleter *completer = new QCompleter(values, edit);
+        completer->setCaseSensitivity(Qt::CaseInsensitive);
+        completer->setFilterMode(Qt::MatchContains);
+        edit->setCompleter(completer);
+    }
+    if(old != nullptr) {
+        old->deleteLater();
+    }
+}
+
 // 增加高度用来放置输入框
 QSize EnhancedHeader::sizeHint() const
 {
@@ -16,6 +16,7 @@ public:
     QSize sectionSizeFromContents(int logicalIndex) const override;
     bool restoreState(const QByteArray &state);
     void setStretchSection(int logicalIndex);
+    void setFilterValues(int logicalIndex, const QStringList &values);
 
 signals:
     void filterChanged(int logicalIndex, QString filter);
@@ -26,6 +27,9 @@ private slots:
 
 private:
     QList<QLineEdit*> editors;
+    QHash<int, QStringList> filterValues;
+
+    void setFilterCompleter(QLineEdit *edit, const QStringList &values);
 
     QSize sizeHint() const override;
     void paintSection(QPainter *painter, const QRect &rect,
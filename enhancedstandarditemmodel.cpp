@@ -1,14 +1,38 @@
 #include "enhancedstandarditemmodel.h"
 #include <QTextDocument>
+#include <QSet>
+#include <QTimer>
 #include <QtDebug>
 
 EnhancedStandardItemModel::EnhancedStandardItemModel(QObject *parent):
     QStandardItemModel(parent)
-{}
+{
+    initialize();
+}
 
 EnhancedStandardItemModel::EnhancedStandardItemModel(int rows, int columns,
                                                      QObject *parent): QStandardItemModel (rows, columns, parent)
-{}
+{
+    initialize();
+}
+
+void EnhancedStandardItemModel::initialize()
+{
+    connect(this, &QAbstractItemModel::dataChanged, this,
+            &EnhancedStandardItemModel::updateDictionaryCodes);
+    connect(this, &QAbstractItemModel::rowsInserted, this,
+            &EnhancedStandardItemModel::insertDictionaryRows);
+    connect(this, &QAbstractItemModel::rowsRemoved, this,
+            &EnhancedStandardItemModel::removeDictionaryRows);
+    connect(this, &QAbstractItemModel::columnsInserted, this,
+            &EnhancedStandardItemModel::insertDictionaryColumns);
+    connect(this, &QAbstractItemModel::columnsRemoved, this,
+            &EnhancedStandardItemModel::removeDictionaryColumns);
+    connect(this, &QAbstractItemModel::layoutChanged, this,
+            &EnhancedStandardItemModel::rebuildDictionaries);
+    connect(this, &QAbstractItemModel::modelReset, this,
+            &EnhancedStandardItemModel::rebuildDictionaries);
+}
 
 Qt::ItemFlags EnhancedStandardItemModel::flags(const QModelIndex &index) const
 {
@@ -35,6 +59,27 @@ QVariant EnhancedStandardItemModel::data(const QModelIndex &index, int role) con
     return QStandardItemModel::data(index, role);
 }
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+// 一次调用返回多个角色，只在请求勾选状态时查哈希表
+void EnhancedStandardItemModel::multiData(const QModelIndex &index,
+                                          QModelRoleDataSpan roleDataSpan) const
+{
+    QStandardItemModel::multiData(index, roleDataSpan);
+    if(!index.isValid()) {
+        return;
+    }
+
+    for(QModelRoleData &roleData : roleDataSpan) {
+        if(roleData.role() == Qt::CheckStateRole) {
+            auto it = checkState.constFind(index);
+            if(it != checkState.constEnd()) {
+                roleData.setData(static_cast<int>(it.value()));
+            }
+        }
+    }
+}
+#endif
+
 bool EnhancedStandardItemModel::setData(const QModelIndex &index,
                                         const QVariant &value, int role)
 {
@@ -50,8 +95,343 @@ bool EnhancedStandardItemModel::setData(const QModelIndex &index,
     } else if (role == HtmlRole) {
         QTextDocument doc;
         doc.setHtml(value.toString());
-        QStandardItemModel::setData(index, doc.toPlainText());
+        QStandardItemModel::setData(index, internValue(index.column(), doc.toPlainText()));
+    } else if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        // 字典编码列共享同一份字符串
+        if(value.userType() == QMetaType::QString && dictionaries.contains(index.column())) {
+            return QStandardItemModel::setData(index, internValue(index.column(),
+                                                                  value.toString()), role);
+        }
     }
 
     return QStandardItemModel::setData(index, value, role);
 }
+
+void EnhancedStandardItemModel::setColumnDictionaryEncoded(int column, bool on)
+{
+    if(on == dictionaries.contains(column)) {
+        return;
+    }
+
+    if(on) {
+        dictionaries.insert(column, ColumnDictionary());
+        encodeColumn(column);
+    } else {
+        dictionaries.remove(column);
+    }
+    emit columnDictionaryChanged(column);
+}
+
+bool EnhancedStandardItemModel::isColumnDictionaryEncoded(int column) const
+{
+    return dictionaries.contains(column);
+}
+
+// 自动识别不同取值较少的列并进行字典编码
+void EnhancedStandardItemModel::detectDictionaryColumns(int maxDistinct)
+{
+    int rowCount = this->rowCount();
+    int colCount = this->columnCount();
+    for(int j = 0; j < colCount; j++) {
+        if(dictionaries.contains(j)) {
+            continue;
+        }
+        QSet<QString> distinct;
+        for(int i = 0; i < rowCount && distinct.size() <= maxDistinct; i++) {
+            distinct.insert(QStandardItemModel::data(index(i, j)).toString());
+        }
+        if(distinct.size() <= maxDistinct && distinct.size() < rowCount) {
+            setColumnDictionaryEncoded(j, true);
+        }
+    }
+}
+
+QStringList EnhancedStandardItemModel::columnDictionary(int column) const
+{
+    QStringList values;
+    auto it = dictionaries.constFind(column);
+    if(it != dictionaries.constEnd()) {
+        for(int i = 0; i < it->values.size(); i++) {
+            if(it->refCounts.at(i) > 0) {
+                values << it->values.at(i);
+            }
+        }
+    }
+    return values;
+}
+
+/*
+ * 字典编码列只需对每个不同取值做一次匹配，再通过编码映射到行。
+ * candidates为空时检查所有行，否则只检查其中置位的行
+*/
+QBitArray EnhancedStandardItemModel::matchRows(int column, const QString &key,
+                                               const QBitArray &candidates,
+                                               Qt::CaseSensitivity cs) const
+{
+    int rowCount = this->rowCount();
+    QBitArray rows = candidates.size() == rowCount ? candidates : QBitArray(rowCount, true);
+    if(key.isEmpty()) {
+        return rows;
+    }
+
+    auto it = dictionaries.constFind(column);
+    if(it == dictionaries.constEnd() || it->codes.size() != rowCount) {
+        for(int i = 0; i < rowCount; i++) {
+            if(rows.testBit(i)) {
+                QString data = QStandardItemModel::data(index(i, column)).toString();
+                rows.setBit(i, data.contains(key, cs));
+            }
+        }
+        return rows;
+    }
+
+    const ColumnDictionary &dict = it.value();
+    int valueCount = dict.values.size();
+    QBitArray valueMatch(valueCount);
+    for(int i = 0; i < valueCount; i++) {
+        if(dict.refCounts.at(i) > 0) {
+            valueMatch.setBit(i, dict.values.at(i).contains(key, cs));
+        }
+    }
+    const quint16 *codes = dict.codes.constData();
+    for(int i = 0; i < rowCount; i++) {
+        if(rows.testBit(i)) {
+            rows.setBit(i, valueMatch.testBit(codes[i]));
+        }
+    }
+    return rows;
+}
+
+QString EnhancedStandardItemModel::internValue(int column, const QString &value) const
+{
+    auto it = dictionaries.constFind(column);
+    if(it != dictionaries.constEnd()) {
+        auto found = it->lookup.constFind(value);
+        if(found != it->lookup.constEnd()) {
+            return it->values.at(found.value());
+        }
+    }
+    return value;
+}
+
+/*
+ * 返回单元格的字典编码，字典已满时返回-1。
+ * replace为true时该行已有编码，需要释放原取值的引用
+*/
+int EnhancedStandardItemModel::encodeCell(ColumnDictionary &dict, int row, int column,
+                                          bool replace)
+{
+    QString value = QStandardItemModel::data(index(row, column)).toString();
+    int code = dict.lookup.value(value, -1);
+    if(code < 0) {
+        if(dict.values.size() >= maxDictionarySize) {
+            return -1;
+        }
+        code = dict.values.size();
+        dict.values.append(value);
+        dict.lookup.insert(value, code);
+        dict.refCounts.append(0);
+    }
+    if(row >= dict.codes.size()) {
+        dict.codes.resize(rowCount());
+        replace = false;
+    }
+    if(replace) {
+        int oldCode = dict.codes[row];
+        if(oldCode == code) {
+            return code;
+        }
+        if(--dict.refCounts[oldCode] == 0) {
+            dict.liveChanged = true;
+        }
+    }
+    dict.codes[row] = static_cast<quint16>(code);
+    if(dict.refCounts[code]++ == 0) {
+        dict.liveChanged = true;
+    }
+    return code;
+}
+
+// 字典已满时按当前数据重新编码，回收不再被引用的取值
+void EnhancedStandardItemModel::encodeRows(int column, int first, int last, bool replace)
+{
+    ColumnDictionary &dict = dictionaries[column];
+    dict.liveChanged = false;
+    bool full = false;
+    // appendRow、QStandardItem::setText等途径写入的字符串也换成字典中的共享实例
+    bool oldState = blockSignals(true);
+    for(int i = first; i <= last && !full; i++) {
+        int code = encodeCell(dict, i, column, replace);
+        full = code < 0;
+        if(!full) {
+            internCell(i, column, dict.values.at(code));
+        }
+    }
+    blockSignals(oldState);
+    if(full) {
+        encodeColumn(column);
+        scheduleDictionaryChanged(column);
+    } else if(dict.liveChanged) {
+        scheduleDictionaryChanged(column);
+    }
+}
+
+void EnhancedStandardItemModel::encodeColumn(int column)
+{
+    ColumnDictionary &dict = dictionaries[column];
+    dict = ColumnDictionary();
+    int rowCount = this->rowCount();
+    dict.codes.resize(rowCount);
+
+    /*
+     * QStandardItem::setData遇到相等的值会直接返回，
+     * 需先清除再写入字典中的共享字符串，才能释放重复的字符串
+    */
+    bool oldState = blockSignals(true);
+    for(int i = 0; i < rowCount; i++) {
+        int code = encodeCell(dict, i, column, false);
+        if(code < 0) {
+            blockSignals(oldState);
+            dictionaries.remove(column);
+            qWarning() << "column" << column << "has more than" << maxDictionarySize
+                       << "distinct values, dictionary encoding disabled";
+            return;
+        }
+        internCell(i, column, dict.values.at(code));
+    }
+    blockSignals(oldState);
+}
+
+// 只替换以字符串存放的单元格，数值等类型保持原样以免影响排序和显示格式
+void EnhancedStandardItemModel::internCell(int row, int column, const QString &shared)
+{
+    QStandardItem *item = this->item(row, column);
+    if(item == nullptr) {
+        return;
+    }
+    QVariant value = item->data(Qt::DisplayRole);
+    if(value.userType() != QMetaType::QString ||
+            value.toString().constData() == shared.constData()) {
+        return;
+    }
+    item->setData(QVariant(), Qt::DisplayRole);
+    item->setData(shared, Qt::DisplayRole);
+}
+
+void EnhancedStandardItemModel::updateDictionaryCodes(const QModelIndex &topLeft,
+                                                      const QModelIndex &bottomRight)
+{
+    if(dictionaries.isEmpty() || !topLeft.isValid() || topLeft.parent().isValid()) {
+        return;
+    }
+
+    QList<int> columns = dictionaries.keys();
+    for(int column : columns) {
+        if(column >= topLeft.column() && column <= bottomRight.column()) {
+            encodeRows(column, topLeft.row(), bottomRight.row(), true);
+        }
+    }
+}
+
+void EnhancedStandardItemModel::insertDictionaryRows(const QModelIndex &parent,
+                                                     int first, int last)
+{
+    if(dictionaries.isEmpty() || parent.isValid()) {
+        return;
+    }
+
+    QList<int> columns = dictionaries.keys();
+    for(int column : columns) {
+        dictionaries[column].codes.insert(first, last - first + 1, 0);
+        encodeRows(column, first, last, false);
+    }
+}
+
+void EnhancedStandardItemModel::removeDictionaryRows(const QModelIndex &parent,
+                                                     int first, int last)
+{
+    if(dictionaries.isEmpty() || parent.isValid()) {
+        return;
+    }
+
+    QList<int> columns = dictionaries.keys();
+    for(int column : columns) {
+        ColumnDictionary &dict = dictionaries[column];
+        bool liveChanged = false;
+        for(int i = first; i <= last && i < dict.codes.size(); i++) {
+            if(--dict.refCounts[dict.codes.at(i)] == 0) {
+                liveChanged = true;
+            }
+        }
+        if(first < dict.codes.size()) {
+            dict.codes.remove(first, qMin(last, dict.codes.size() - 1) - first + 1);
+        }
+        if(liveChanged) {
+            scheduleDictionaryChanged(column);
+        }
+    }
+}
+
+void EnhancedStandardItemModel::insertDictionaryColumns(const QModelIndex &parent,
+                                                        int first, int last)
+{
+    if(dictionaries.isEmpty() || parent.isValid()) {
+        return;
+    }
+
+    QHash<int, ColumnDictionary> shifted;
+    for(auto it = dictionaries.begin(); it != dictionaries.end(); ++it) {
+        int column = it.key() < first ? it.key() : it.key() + last - first + 1;
+        shifted.insert(column, it.value());
+    }
+    dictionaries = shifted;
+}
+
+void EnhancedStandardItemModel::removeDictionaryColumns(const QModelIndex &parent,
+                                                        int first, int last)
+{
+    if(dictionaries.isEmpty() || parent.isValid()) {
+        return;
+    }
+
+    QHash<int, ColumnDictionary> shifted;
+    for(auto it = dictionaries.begin(); it != dictionaries.end(); ++it) {
+        if(it.key() < first) {
+            shifted.insert(it.key(), it.value());
+        } else if(it.key() > last) {
+            shifted.insert(it.key() - (last - first + 1), it.value());
+        }
+    }
+    dictionaries = shifted;
+}
+
+/*
+ * 逐行加载时每出现一个新取值都会变化，合并到事件循环空闲时统一通知，
+ * 避免过滤框的下拉列表被反复重建
+*/
+void EnhancedStandardItemModel::scheduleDictionaryChanged(int column)
+{
+    if(pendingDictionaryColumns.isEmpty()) {
+        QTimer::singleShot(0, this, &EnhancedStandardItemModel::emitDictionaryChanged);
+    }
+    pendingDictionaryColumns.insert(column);
+}
+
+void EnhancedStandardItemModel::emitDictionaryChanged()
+{
+    QSet<int> columns = pendingDictionaryColumns;
+    pendingDictionaryColumns.clear();
+    for(int column : columns) {
+        emit columnDictionaryChanged(column);
+    }
+}
+
+// 排序或重置后行号全部失效，重新编码
+void EnhancedStandardItemModel::rebuildDictionaries()
+{
+    QList<int> columns = dictionaries.keys();
+    for(int column : columns) {
+        encodeColumn(column);
+        scheduleDictionaryChanged(column);
+    }
+}
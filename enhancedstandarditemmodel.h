@@ -2,6 +2,8 @@
 #define ENHANCEDSTANDARDITEMMODEL_H
 
 #include <QStandardItemModel>
+#include <QBitArray>
+#include <QSet>
 
 class EnhancedStandardItemModel: public QStandardItemModel
 {
@@ -12,6 +14,9 @@ public:
 
     Qt::ItemFlags flags(const QModelIndex &index) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    void multiData(const QModelIndex &index, QModelRoleDataSpan roleDataSpan) const override;
+#endif
     bool setData(const QModelIndex &index, const QVariant &value,
                  int role = Qt::EditRole) override;
 
@@ -21,9 +26,51 @@ public:
     }
     enum role{HtmlRole = Qt::UserRole + 200};
 
+    // 低基数列字典编码
+    void setColumnDictionaryEncoded(int column, bool on);
+    bool isColumnDictionaryEncoded(int column) const;
+    void detectDictionaryColumns(int maxDistinct = 64);
+    QStringList columnDictionary(int column) const;
+    QBitArray matchRows(int column, const QString &key,
+                        const QBitArray &candidates = QBitArray(),
+                        Qt::CaseSensitivity cs = Qt::CaseInsensitive) const;
+
+signals:
+    void columnDictionaryChanged(int column);
+
+private slots:
+    void updateDictionaryCodes(const QModelIndex &topLeft,
+                               const QModelIndex &bottomRight);
+    void insertDictionaryRows(const QModelIndex &parent, int first, int last);
+    void removeDictionaryRows(const QModelIndex &parent, int first, int last);
+    void insertDictionaryColumns(const QModelIndex &parent, int first, int last);
+    void removeDictionaryColumns(const QModelIndex &parent, int first, int last);
+    void rebuildDictionaries();
+    void emitDictionaryChanged();
+
 private:
+    struct ColumnDictionary {
+        QStringList values;
+        QHash<QString, int> lookup;
+        QVector<quint16> codes;
+        // 每个取值被多少行引用，为0的取值不再出现在列中
+        QVector<int> refCounts;
+        bool liveChanged = false;
+    };
+    static const int maxDictionarySize = 65535;
+
+    void initialize();
+    QString internValue(int column, const QString &value) const;
+    int encodeCell(ColumnDictionary &dict, int row, int column, bool replace);
+    void encodeRows(int column, int first, int last, bool replace);
+    void encodeColumn(int column);
+    void internCell(int row, int column, const QString &shared);
+    void scheduleDictionaryChanged(int column);
+
     QList<int> checkColumns;
     QHash<QModelIndex, Qt::CheckState> checkState;
+    QHash<int, ColumnDictionary> dictionaries;
+    QSet<int> pendingDictionaryColumns;
 };
 
 #endif // ENHANCEDSTANDARDITEMMODEL_H
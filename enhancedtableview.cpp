@@ -7,6 +7,14 @@
 #include <QtDebug>
 #include <QAbstractTextDocumentLayout>
 #include <QLineEdit>
+#include <QBitArray>
+#include <QScrollBar>
+#include <QShortcut>
+#include <QIcon>
+#include <QPixmap>
+#include <QImage>
+#include <array>
+#include <QElapsedTimer>
 
 EnhancedTableView::EnhancedTableView(QWidget *parent): QTableView (parent)
 {
@@ -19,6 +27,25 @@ EnhancedTableView::EnhancedTableView(QWidget *parent): QTableView (parent)
 
     connect(header, &EnhancedHeader::filterChanged, this,
             &EnhancedTableView::filterData);
+
+    documents.reset(new QCache<QString, QTextDocument>(JumpDelegate::documentCacheCost));
+
+    footer = new EnhancedFooter(this);
+    footer->setVisible(false);
+    connect(horizontalScrollBar(), &QScrollBar::valueChanged, footer, [ = ]() {
+        footer->update();
+    });
+
+    quickFind = new QuickFindBar(this);
+    quickFind->setVisible(false);
+    QShortcut *findShortcut = new QShortcut(QKeySequence::Find, this);
+    findShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+    connect(findShortcut, &QShortcut::activated, this, &EnhancedTableView::showQuickFind);
+
+    prefetchTimer.setInterval(0);
+    connect(&prefetchTimer, &QTimer::timeout, this, &EnhancedTableView::prefetchSlice);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+            &EnhancedTableView::schedulePrefetch);
 }
 
 void EnhancedTableView::mousePressEvent(QMouseEvent *event)
@@ -74,12 +101,8 @@ QString EnhancedTableView::anchorAt(const QPoint &pos) const
             QPoint relativeClickPosition = pos - itemRect.topLeft();
             QString html = model()->data(index, EnhancedStandardItemModel::HtmlRole).toString();
 
-            QTextDocument doc;
-            doc.setDefaultFont(this->font());
-            doc.setHtml(html);
-            doc.setTextWidth(width);
-
-            auto textLayout = doc.documentLayout();
+            QTextDocument *doc = delegate->document(html, this->font(), width);
+            auto textLayout = doc->documentLayout();
             Q_ASSERT(textLayout != nullptr);
             return textLayout->anchorAt(relativeClickPosition);
         }
@@ -103,6 +126,164 @@ void EnhancedTableView::setHorizontalHeaderWrap(bool on)
     }
 }
 
+void EnhancedTableView::setShowAggregates(bool on)
+{
+    footer->setVisible(on);
+    updateGeometries();
+}
+
+void EnhancedTableView::setAggregates(EnhancedFooter::Aggregates aggregates)
+{
+    footer->setAggregates(aggregates);
+    updateGeometries();
+}
+
+void EnhancedTableView::showQuickFind()
+{
+    quickFind->activate();
+    updateGeometries();
+}
+
+QuickFindBar::MatchState EnhancedTableView::findMatchState(const QModelIndex &index) const
+{
+    if(quickFind == nullptr) {
+        return QuickFindBar::NoMatch;
+    }
+    return quickFind->matchState(index);
+}
+
+void EnhancedTableView::setPrefetchEnabled(bool on)
+{
+    prefetchEnabled = on;
+    if(!on) {
+        prefetchTimer.stop();
+    }
+}
+
+void EnhancedTableView::setPrefetchLookAhead(int rows)
+{
+    prefetchLookAhead = rows;
+}
+
+void EnhancedTableView::setPrefetchBudget(int msec)
+{
+    prefetchBudget = msec;
+}
+
+/*
+ * 按滚动方向预取视口外的行：在空闲时分片执行，每片不超过prefetchBudget毫秒，
+ * 提前排版html、计算行高所需的文档和超链接命中测试用的文档
+*/
+void EnhancedTableView::schedulePrefetch()
+{
+    if(!prefetchEnabled || model() == nullptr) {
+        return;
+    }
+
+    int value = verticalScrollBar()->value();
+    if(value != lastScrollValue) {
+        prefetchDirection = value > lastScrollValue ? 1 : -1;
+        lastScrollValue = value;
+    }
+
+    int firstRow = rowAt(0);
+    if(firstRow < 0) {
+        return;
+    }
+    int lastRow = rowAt(viewport()->height() - 1);
+    if(lastRow < 0) {
+        lastRow = model()->rowCount(rootIndex()) - 1;
+    }
+
+    prefetchRow = prefetchDirection > 0 ? lastRow + 1 : firstRow - 1;
+    prefetchRemaining = prefetchLookAhead;
+    prefetchTimer.start();
+}
+
+void EnhancedTableView::prefetchSlice()
+{
+    QAbstractItemModel *model = this->model();
+    int firstColumn = columnAt(0);
+    if(model == nullptr || firstColumn < 0) {
+        prefetchTimer.stop();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if(prefetchDirection > 0 && prefetchRow + prefetchRemaining >= model->rowCount(rootIndex()) &&
+            model->canFetchMore(rootIndex())) {
+        model->fetchMore(rootIndex());
+    }
+
+    QHeaderView *header = horizontalHeader();
+    int lastColumn = columnAt(viewport()->width() - 1);
+    int firstVisual = header->visualIndex(firstColumn);
+    int lastVisual = lastColumn < 0 ? header->count() - 1 : header->visualIndex(lastColumn);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QStyleOptionViewItem option;
+    initViewItemOption(&option);
+#else
+    QStyleOptionViewItem option = viewOptions();
+#endif
+
+    int rowCount = model->rowCount(rootIndex());
+    // 过滤隐藏的行直接跳过，不占用预取行数
+    while(prefetchRow >= 0 && prefetchRow < rowCount && prefetchRemaining > 0) {
+        if(!isRowHidden(prefetchRow)) {
+            prefetchRemaining--;
+            for(int visual = firstVisual; visual <= lastVisual; visual++) {
+                int column = header->logicalIndex(visual);
+                auto delegate = qobject_cast<JumpDelegate*>(itemDelegateForColumn(column));
+                if(delegate == nullptr || isColumnHidden(column)) {
+                    continue;
+                }
+                QModelIndex index = model->index(prefetchRow, column, rootIndex());
+                option.rect = visualRect(index);
+                delegate->prefetch(option, index, columnWidth(column) - 1);
+            }
+        }
+        prefetchRow += prefetchDirection;
+        if(timer.elapsed() >= prefetchBudget) {
+            return;
+        }
+    }
+    prefetchTimer.stop();
+}
+
+// 在视口下方留出汇总行的位置，查找栏浮动在视口右上角
+void EnhancedTableView::updateGeometries()
+{
+    QTableView::updateGeometries();
+    if(quickFind != nullptr && quickFind->isVisible()) {
+        QRect rect = viewport()->geometry();
+        QSize size = quickFind->sizeHint();
+        size.setWidth(qMin(size.width() * 2, rect.width()));
+        quickFind->setGeometry(rect.right() + 1 - size.width(), rect.top(),
+                               size.width(), size.height());
+    }
+    if(footer == nullptr) {
+        return;
+    }
+
+    QMargins margins = viewportMargins();
+    if(footer->isHidden()) {
+        if(margins.bottom() != 0) {
+            margins.setBottom(0);
+            setViewportMargins(margins);
+        }
+        return;
+    }
+
+    int height = footer->sizeHint().height();
+    if(margins.bottom() != height) {
+        margins.setBottom(height);
+        setViewportMargins(margins);
+    }
+    QRect rect = viewport()->geometry();
+    footer->setGeometry(rect.left(), rect.bottom() + 1, rect.width(), height);
+}
+
 void EnhancedTableView::filterData(int col, QString key)
 {
     if(key == "") {
@@ -113,107 +294,360 @@ void EnhancedTableView::filterData(int col, QString key)
 
     QAbstractItemModel *model = this->model();
     if(model != nullptr) {
-        int colCount = model->columnCount();
         int rowCount = model->rowCount();
+        QBitArray visible(rowCount, true);
 
-        for (int i = 0; i < rowCount; i++) {
-            bool hasAllKey = true;
-            for (int j = 0; j < colCount; j++) {
-                QModelIndex index = model->index(i, j);
-                QString data = model->data(index).toString();
-
-                if(!data.contains(filterMap.value(j), Qt::CaseInsensitive)) {
-                    hasAllKey = false;
-                    break;
+        auto enhancedModel = qobject_cast<EnhancedStandardItemModel*>(model);
+        for(auto it = filterMap.constBegin(); it != filterMap.constEnd(); ++it) {
+            if(enhancedModel != nullptr) {
+                visible = enhancedModel->matchRows(it.key(), it.value(), visible);
+                continue;
+            }
+            for (int i = 0; i < rowCount; i++) {
+                if(!visible.testBit(i)) {
+                    continue;
                 }
+                QString data = model->data(model->index(i, it.key())).toString();
+                visible.setBit(i, data.contains(it.value(), Qt::CaseInsensitive));
             }
-            setRowHidden(i, !hasAllKey);
         }
+
+        for (int i = 0; i < rowCount; i++) {
+            setRowHidden(i, !visible.testBit(i));
+        }
+        footer->setVisibleRows(visible);
+        quickFind->restart();
     }
 }
 
+void EnhancedTableView::updateFilterValues(int column)
+{
+    auto model = qobject_cast<EnhancedStandardItemModel*>(this->model());
+    auto header = dynamic_cast<EnhancedHeader*>(horizontalHeader());
+    if(model == nullptr || header == nullptr) {
+        return;
+    }
+    header->setFilterValues(column, model->columnDictionary(column));
+}
+
 void EnhancedTableView::setModel(QAbstractItemModel *model)
 {
     int oldColCount = 0;
     if(this->model() != nullptr) {
         oldColCount = this->model()->columnCount();
     }
+    auto oldModel = qobject_cast<EnhancedStandardItemModel*>(this->model());
+    if(oldModel != nullptr) {
+        disconnect(oldModel, &EnhancedStandardItemModel::columnDictionaryChanged,
+                   this, &EnhancedTableView::updateFilterValues);
+    }
 
     QTableView::setModel(model);
 
     int newColCount = model->columnCount();
     for(int i = oldColCount; i < newColCount; i++) {
         JumpDelegate *delegate = new JumpDelegate(this);
+        delegate->setDocumentCache(documents);
         this->setItemDelegateForColumn(i, delegate);
     }
     int rowCount = model->rowCount();
     for(int i = 0; i < rowCount; i++) {
         setRowHidden(i, false);
     }
+    footer->setModel(model);
+    quickFind->setModel(model);
+    lastScrollValue = verticalScrollBar()->value();
+    prefetchDirection = 1;
+    schedulePrefetch();
+
+    // 字典编码列的取值作为过滤框的下拉选项
+    auto enhancedModel = qobject_cast<EnhancedStandardItemModel*>(model);
+    if(enhancedModel != nullptr) {
+        connect(enhancedModel, &EnhancedStandardItemModel::columnDictionaryChanged,
+                this, &EnhancedTableView::updateFilterValues);
+    }
+    for(int i = 0; i < newColCount; i++) {
+        updateFilterValues(i);
+    }
+}
+
+/*
+ * 导出当前可见的行和列，在后台线程写入文件。
+ * 返回的导出对象在finished信号后自动销毁，可用于监听进度或取消导出
+*/
+TableExporter *EnhancedTableView::exportVisible(const QString &fileName,
+                                                TableExporter::Format format, bool keepHtml)
+{
+    QAbstractItemModel *model = this->model();
+    if(model == nullptr) {
+        return nullptr;
+    }
+
+    int rowCount = model->rowCount();
+    QBitArray rows(rowCount);
+    for(int i = 0; i < rowCount; i++) {
+        rows.setBit(i, !isRowHidden(i));
+    }
+    QVector<int> columns;
+    QHeaderView *header = horizontalHeader();
+    for(int visual = 0; visual < header->count(); visual++) {
+        int logical = header->logicalIndex(visual);
+        if(!header->isSectionHidden(logical)) {
+            columns.append(logical);
+        }
+    }
+
+    TableExporter *exporter = new TableExporter(model, rows, columns, this);
+    exporter->setFormat(format);
+    exporter->setKeepHtml(keepHtml);
+    connect(exporter, &TableExporter::finished, exporter, &QObject::deleteLater);
+    exporter->start(fileName);
+    return exporter;
 }
 
 JumpDelegate::JumpDelegate(QObject *parent): QStyledItemDelegate (parent)
-{}
+{
+    documents.reset(new DocumentCache(documentCacheCost));
+}
+
+void JumpDelegate::setDocumentCache(const QSharedPointer<DocumentCache> &cache)
+{
+    documents = cache;
+}
 
 QSize JumpDelegate::sizeHint(const QStyleOptionViewItem &option,
                              const QModelIndex &index) const
 {
     QVariant text = index.model()->data(index);
 
-    QTextDocument doc;
     const QWidget *widget = option.widget;
-    doc.setDefaultFont(widget->font());
-
     QRect textRect = QApplication::style()->
                      subElementRect(QStyle::SE_ItemViewItemText, &option);
-    doc.setTextWidth(textRect.width());
-    doc.setHtml(index.model()->data(index).toString());
-    return doc.size().toSize();
+    QTextDocument *doc = document(text.toString(), widget->font(), textRect.width());
+    return doc->size().toSize();
 }
 
 void JumpDelegate::paint(QPainter *painter,
                          const QStyleOptionViewItem &option,
                          const QModelIndex &index) const
 {
-    QVariant htmlData = index.model()->data(index, EnhancedStandardItemModel::HtmlRole);
-    if(!htmlData.isValid()) {
-        return QStyledItemDelegate::paint(painter, option, index);
-    }
-
-    bool wordWrap = option.features & 0x01;
+    CellData data = fetchCellData(index);
 
     QStyleOptionViewItem opt = option;
-    initStyleOption(&opt, index);
+    initStyleOption(&opt, index, data);
+    const QWidget *widget = option.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    if(!data.html.isValid()) {
+        style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
+        return;
+    }
+
     opt.text = "";
 
     // 取消选中虚线框
     if(opt.state.testFlag(QStyle::State_HasFocus)) {
         opt.state = opt.state ^ QStyle::State_HasFocus;
     }
-    const QWidget *widget = option.widget;
-    QStyle *style = widget ? widget->style() : QApplication::style();
     style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
 
     // 绘制超链接
-    QTextDocument doc;
-    doc.setDefaultFont(widget->font());
-    doc.setHtml(htmlData.toString());
+    QRect textRect;
+    QTextDocument *doc = paintDocument(opt, data.html.toString(), &textRect);
     QAbstractTextDocumentLayout::PaintContext paintContext;
 
-    QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &opt);
     painter->save();
     painter->translate(textRect.topLeft());
     painter->setClipRect(textRect.translated(-textRect.topLeft()));
-    if(!wordWrap) {
-        doc.setTextWidth(65535);
-    } else {
-        doc.setTextWidth(textRect.width());
-    }
-    doc.documentLayout()->draw(painter, paintContext);
+    doc->documentLayout()->draw(painter, paintContext);
 
     painter->restore();
 }
 
+QTextDocument *JumpDelegate::document(const QString &html, const QFont &font, int width) const
+{
+    QString key = font.key() + QChar(0x1f) + QString::number(width) + QChar(0x1f) + html;
+    QTextDocument *doc = documents->object(key);
+    if(doc == nullptr) {
+        doc = new QTextDocument;
+        doc->setDefaultFont(font);
+        doc->setHtml(html);
+        doc->setTextWidth(width);
+        doc->documentLayout()->documentSize();
+        // 排版占用的内存随文本长度增长，以html长度作为开销；超过上限的文档也要保留到下次调用
+        int cost = qBound(1, int(html.size()), int(documents->maxCost()));
+        documents->insert(key, doc, cost);
+    }
+    return doc;
+}
+
+// 预先生成绘制、行高计算及超链接命中测试会用到的文档
+void JumpDelegate::prefetch(const QStyleOptionViewItem &option, const QModelIndex &index,
+                            int anchorWidth) const
+{
+    CellData data = fetchCellData(index);
+    if(!data.html.isValid()) {
+        return;
+    }
+
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index, data);
+    opt.text = "";
+    QRect textRect;
+    paintDocument(opt, data.html.toString(), &textRect);
+    sizeHint(option, index);
+    document(data.html.toString(), option.widget->font(), anchorWidth);
+}
+
+QTextDocument *JumpDelegate::paintDocument(const QStyleOptionViewItem &option,
+                                           const QString &html, QRect *textRect) const
+{
+    const QWidget *widget = option.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    *textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &option);
+    bool wordWrap = option.features.testFlag(QStyleOptionViewItem::WrapText);
+    return document(html, widget->font(), wordWrap ? textRect->width() : 65535);
+}
+
+void JumpDelegate::initStyleOption(QStyleOptionViewItem *option,
+                                   const QModelIndex &index) const
+{
+    initStyleOption(option, index, fetchCellData(index));
+}
+
+/*
+ * 一次取出绘制单元格需要的全部角色。
+ * Qt 6 通过multiData只调用一次模型，Qt 5 退回逐个角色调用data
+*/
+JumpDelegate::CellData JumpDelegate::fetchCellData(const QModelIndex &index) const
+{
+    CellData data;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    std::array<QModelRoleData, 8> roleData = {{
+            QModelRoleData(EnhancedStandardItemModel::HtmlRole),
+            QModelRoleData(Qt::DisplayRole),
+            QModelRoleData(Qt::DecorationRole),
+            QModelRoleData(Qt::FontRole),
+            QModelRoleData(Qt::TextAlignmentRole),
+            QModelRoleData(Qt::ForegroundRole),
+            QModelRoleData(Qt::BackgroundRole),
+            QModelRoleData(Qt::CheckStateRole)
+        }
+    };
+    index.multiData(roleData);
+    data.html = roleData[0].data();
+    data.display = roleData[1].data();
+    data.decoration = roleData[2].data();
+    data.font = roleData[3].data();
+    data.alignment = roleData[4].data();
+    data.foreground = roleData[5].data();
+    data.background = roleData[6].data();
+    data.checkState = roleData[7].data();
+#else
+    data.html = index.data(EnhancedStandardItemModel::HtmlRole);
+    data.display = index.data(Qt::DisplayRole);
+    data.decoration = index.data(Qt::DecorationRole);
+    data.font = index.data(Qt::FontRole);
+    data.alignment = index.data(Qt::TextAlignmentRole);
+    data.foreground = index.data(Qt::ForegroundRole);
+    data.background = index.data(Qt::BackgroundRole);
+    data.checkState = index.data(Qt::CheckStateRole);
+#endif
+    return data;
+}
+
+// 与对应Qt版本的QStyledItemDelegate::initStyleOption一致，数据来自已取出的CellData
+void JumpDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index,
+                                   const CellData &data) const
+{
+    if(data.font.isValid() && !data.font.isNull()) {
+        option->font = qvariant_cast<QFont>(data.font).resolve(option->font);
+        option->fontMetrics = QFontMetrics(option->font);
+    }
+    if(data.alignment.isValid() && !data.alignment.isNull()) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        // 与Qt 6的legacyFlagValueFromModelData一致，兼容以Qt::Alignment或int存放的对齐方式
+        int type = data.alignment.userType();
+        if(type == QMetaType::fromType<Qt::Alignment>().id()) {
+            option->displayAlignment = data.alignment.value<Qt::Alignment>();
+        } else if(type == QMetaType::fromType<Qt::AlignmentFlag>().id()) {
+            option->displayAlignment = data.alignment.value<Qt::AlignmentFlag>();
+        } else {
+            option->displayAlignment = Qt::Alignment(data.alignment.toInt());
+        }
+#else
+        option->displayAlignment = Qt::Alignment(data.alignment.toInt());
+#endif
+    }
+    if(data.foreground.canConvert<QBrush>()) {
+        option->palette.setBrush(QPalette::Text, qvariant_cast<QBrush>(data.foreground));
+    }
+    option->index = index;
+    if(data.checkState.isValid() && !data.checkState.isNull()) {
+        option->features |= QStyleOptionViewItem::HasCheckIndicator;
+        option->checkState = static_cast<Qt::CheckState>(data.checkState.toInt());
+    }
+    if(data.decoration.isValid() && !data.decoration.isNull()) {
+        option->features |= QStyleOptionViewItem::HasDecoration;
+        switch (data.decoration.userType()) {
+        case QMetaType::QIcon: {
+            option->icon = qvariant_cast<QIcon>(data.decoration);
+            QIcon::Mode mode = QIcon::Normal;
+            if(!(option->state & QStyle::State_Enabled)) {
+                mode = QIcon::Disabled;
+            } else if(option->state & QStyle::State_Selected) {
+                mode = QIcon::Selected;
+            }
+            QIcon::State state = option->state & QStyle::State_Open ? QIcon::On : QIcon::Off;
+            QSize actualSize = option->icon.actualSize(option->decorationSize, mode, state);
+            option->decorationSize = option->decorationSize.boundedTo(actualSize);
+            break;
+        }
+        case QMetaType::QColor: {
+            QPixmap pixmap(option->decorationSize);
+            pixmap.fill(qvariant_cast<QColor>(data.decoration));
+            option->icon = QIcon(pixmap);
+            break;
+        }
+        case QMetaType::QImage: {
+            QImage image = qvariant_cast<QImage>(data.decoration);
+            option->icon = QIcon(QPixmap::fromImage(image));
+            option->decorationSize = image.size() / image.devicePixelRatio();
+            break;
+        }
+        case QMetaType::QPixmap: {
+            QPixmap pixmap = qvariant_cast<QPixmap>(data.decoration);
+            option->icon = QIcon(pixmap);
+            option->decorationSize = pixmap.size() / pixmap.devicePixelRatio();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    if(data.display.isValid() && !data.display.isNull()) {
+        option->features |= QStyleOptionViewItem::HasDisplay;
+        option->text = displayText(data.display, option->locale);
+    }
+    option->backgroundBrush = qvariant_cast<QBrush>(data.background);
+    option->styleObject = nullptr;
+
+    // 快速查找的匹配单元格以背景色标出，当前匹配颜色更深
+    auto view = qobject_cast<const EnhancedTableView*>(option->widget);
+    if(view == nullptr) {
+        return;
+    }
+    switch (view->findMatchState(index)) {
+    case QuickFindBar::Match:
+        option->backgroundBrush = QColor(255, 236, 140);
+        break;
+    case QuickFindBar::CurrentMatch:
+        option->backgroundBrush = QColor(255, 170, 60);
+        break;
+    default:
+        break;
+    }
+}
+
 void JumpDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
 {
     QVariant htmlData = index.model()->data(index, EnhancedStandardItemModel::HtmlRole);
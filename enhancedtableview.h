@@ -5,7 +5,14 @@
 #include <QMouseEvent>
 #include <QStyledItemDelegate>
 #include <QStandardItemModel>
+#include <QTextDocument>
+#include <QCache>
+#include <QSharedPointer>
+#include <QTimer>
 #include "enhancedheader.h"
+#include "enhancedfooter.h"
+#include "tableexporter.h"
+#include "quickfindbar.h"
 
 
 class EnhancedTableView: public QTableView
@@ -15,7 +22,16 @@ public:
     EnhancedTableView(QWidget *parent = nullptr);
     void setShowFilters(bool on);
     void setHorizontalHeaderWrap(bool on);
+    void setShowAggregates(bool on);
+    void setAggregates(EnhancedFooter::Aggregates aggregates);
     void setModel(QAbstractItemModel *model) override;
+    void showQuickFind();
+    QuickFindBar::MatchState findMatchState(const QModelIndex &index) const;
+    TableExporter *exportVisible(const QString &fileName, TableExporter::Format format,
+                                 bool keepHtml = false);
+    void setPrefetchEnabled(bool on);
+    void setPrefetchLookAhead(int rows);
+    void setPrefetchBudget(int msec);
 
 signals:
     void linkActivated(QString link);
@@ -24,11 +40,15 @@ signals:
 
 private slots:
     void filterData(int col, QString key);
+    void updateFilterValues(int column);
+    void schedulePrefetch();
+    void prefetchSlice();
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
+    void updateGeometries() override;
 
 private:
     QString anchorAt(const QPoint &pos) const;
@@ -36,6 +56,20 @@ private:
     QString _mousePressAnchor;
     QString _lastHoveredAnchor;
     QHash<int, QString> filterMap;
+    EnhancedFooter *footer = nullptr;
+    QuickFindBar *quickFind = nullptr;
+    // 各列委托共用的文档缓存，整个视图只有一个总上限
+    QSharedPointer<QCache<QString, QTextDocument>> documents;
+
+    QTimer prefetchTimer;
+    bool prefetchEnabled = true;
+    int prefetchLookAhead = 50;
+    int prefetchBudget = 4;
+    int prefetchDirection = 1;
+    int prefetchRow = -1;
+    // 尚需预取的可见行数，隐藏行不计入
+    int prefetchRemaining = 0;
+    int lastScrollValue = 0;
 };
 
 class JumpDelegate: public QStyledItemDelegate
@@ -51,6 +85,42 @@ public:
     void setEditorData(QWidget *editor, const QModelIndex &index) const override;
     void setModelData(QWidget *editor, QAbstractItemModel *model,
                       const QModelIndex &index) const override;
+    void prefetch(const QStyleOptionViewItem &option, const QModelIndex &index,
+                  int anchorWidth) const;
+
+protected:
+    void initStyleOption(QStyleOptionViewItem *option,
+                         const QModelIndex &index) const override;
+
+private:
+    friend class EnhancedTableView;
+
+    typedef QCache<QString, QTextDocument> DocumentCache;
+    // 缓存上限按html字符数计算
+    static const int documentCacheCost = 1 << 20;
+
+    struct CellData {
+        QVariant html;
+        QVariant display;
+        QVariant decoration;
+        QVariant font;
+        QVariant alignment;
+        QVariant foreground;
+        QVariant background;
+        QVariant checkState;
+    };
+
+    CellData fetchCellData(const QModelIndex &index) const;
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index,
+                         const CellData &data) const;
+    void setDocumentCache(const QSharedPointer<DocumentCache> &cache);
+    // 返回的文档归缓存所有，只在下一次调用任一共用该缓存的委托的document前有效
+    QTextDocument *document(const QString &html, const QFont &font, int width) const;
+    QTextDocument *paintDocument(const QStyleOptionViewItem &option,
+                                 const QString &html, QRect *textRect) const;
+
+    // 已排版的文档缓存，键包含字体、宽度和html，数据或列宽变化后自然失效
+    QSharedPointer<DocumentCache> documents;
 
 };
 
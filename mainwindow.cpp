@@ -40,6 +40,12 @@ MainWindow::MainWindow(QWidget *parent) :
     */
     tableView->setHorizontalHeaderWrap(true);
 
+    /*
+     * aggregate footer feature,count/sum/min/max/average of numeric columns for visible rows,
+     * default disable
+    */
+    tableView->setShowAggregates(true);
+
     /*
      * checkBox feature,set cell(1,1) to checkBox
     */
@@ -56,6 +62,12 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(tableView, &EnhancedTableView::linkActivated, this, [ = ](QString link) {
         qDebug() << link;
     });
+
+    /*
+     * dictionary encoding feature,low-cardinality columns share one string per value,
+     * declare column 0 explicitly,detectDictionaryColumns() would find such columns automatically
+    */
+    model->setColumnDictionaryEncoded(0, true);
 }
 
 MainWindow::~MainWindow()
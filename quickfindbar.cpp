@@ -0,0 +1,359 @@
+#include "quickfindbar.h"
+#include "enhancedstandarditemmodel.h"
+#include <QHBoxLayout>
+#include <QToolButton>
+#include <QShortcut>
+#include <QElapsedTimer>
+#include <QtDebug>
+#include <algorithm>
+
+QuickFindBar::QuickFindBar(QTableView *view): QWidget (view), view(view)
+{
+    setAutoFillBackground(true);
+
+    edit = new QLineEdit(this);
+    edit->setPlaceholderText("查找");
+    edit->setClearButtonEnabled(true);
+    label = new QLabel(this);
+    label->setMinimumWidth(fontMetrics().horizontalAdvance("0000/0000+"));
+
+    QToolButton *previousButton = new QToolButton(this);
+    previousButton->setArrowType(Qt::UpArrow);
+    previousButton->setAutoRaise(true);
+    QToolButton *nextButton = new QToolButton(this);
+    nextButton->setArrowType(Qt::DownArrow);
+    nextButton->setAutoRaise(true);
+    QToolButton *closeButton = new QToolButton(this);
+    closeButton->setText("×");
+    closeButton->setAutoRaise(true);
+
+    QHBoxLayout *layout = new QHBoxLayout(this);
+    layout->setContentsMargins(4, 2, 4, 2);
+    layout->setSpacing(2);
+    layout->addWidget(edit);
+    layout->addWidget(label);
+    layout->addWidget(previousButton);
+    layout->addWidget(nextButton);
+    layout->addWidget(closeButton);
+
+    connect(edit, &QLineEdit::textChanged, this, [ = ]() {
+        restart();
+        findNext();
+    });
+    connect(edit, &QLineEdit::returnPressed, this, &QuickFindBar::findNext);
+    connect(previousButton, &QToolButton::clicked, this, &QuickFindBar::findPrevious);
+    connect(nextButton, &QToolButton::clicked, this, &QuickFindBar::findNext);
+    connect(closeButton, &QToolButton::clicked, this, &QuickFindBar::dismiss);
+    QShortcut *previousShortcut = new QShortcut(QKeySequence(Qt::SHIFT | Qt::Key_Return), edit);
+    previousShortcut->setContext(Qt::WidgetShortcut);
+    connect(previousShortcut, &QShortcut::activated, this, &QuickFindBar::findPrevious);
+    QShortcut *closeShortcut = new QShortcut(QKeySequence(Qt::Key_Escape), this);
+    closeShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+    connect(closeShortcut, &QShortcut::activated, this, &QuickFindBar::dismiss);
+
+    connect(&scanTimer, &QTimer::timeout, this, &QuickFindBar::scanSlice);
+    // 匹配按屏幕上的列顺序排列，移动列后重新扫描
+    connect(view->horizontalHeader(), &QHeaderView::sectionMoved, this, &QuickFindBar::restart);
+}
+
+void QuickFindBar::setModel(QAbstractItemModel *model)
+{
+    if(this->model != nullptr) {
+        disconnect(this->model, nullptr, this, nullptr);
+    }
+    this->model = model;
+
+    if(model != nullptr) {
+        connect(model, &QAbstractItemModel::dataChanged, this, &QuickFindBar::rescanRange);
+        connect(model, &QAbstractItemModel::rowsInserted, this, &QuickFindBar::restart);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &QuickFindBar::restart);
+        connect(model, &QAbstractItemModel::columnsInserted, this, &QuickFindBar::restart);
+        connect(model, &QAbstractItemModel::columnsRemoved, this, &QuickFindBar::restart);
+        connect(model, &QAbstractItemModel::layoutChanged, this, &QuickFindBar::restart);
+        connect(model, &QAbstractItemModel::modelReset, this, &QuickFindBar::restart);
+    }
+    restart();
+}
+
+QuickFindBar::MatchState QuickFindBar::matchState(const QModelIndex &index) const
+{
+    if(hits.isEmpty()) {
+        return NoMatch;
+    }
+
+    qint64 key = cellKey(index.row(), view->horizontalHeader()->visualIndex(index.column()));
+    auto it = std::lower_bound(hits.constBegin(), hits.constEnd(), key);
+    if(it == hits.constEnd() || *it != key) {
+        return NoMatch;
+    }
+    return it - hits.constBegin() == current ? CurrentMatch : Match;
+}
+
+int QuickFindBar::matchCount() const
+{
+    return hits.size();
+}
+
+bool QuickFindBar::isScanning() const
+{
+    return scanning;
+}
+
+void QuickFindBar::activate()
+{
+    show();
+    raise();
+    edit->setFocus();
+    edit->selectAll();
+}
+
+void QuickFindBar::dismiss()
+{
+    hide();
+    edit->clear();
+    view->setFocus();
+}
+
+void QuickFindBar::findNext()
+{
+    pending = PendingNext;
+    pendingAnchor = current >= 0 ? hits[current] : currentKey() - 1;
+    resolvePending();
+}
+
+void QuickFindBar::findPrevious()
+{
+    pending = PendingPrevious;
+    pendingAnchor = current >= 0 ? hits[current] : currentKey();
+    resolvePending();
+}
+
+/*
+ * 查找条件、模型或过滤结果变化后重新扫描。
+ * 扫描在事件循环中分片进行，每片不超过sliceBudget毫秒，找到的匹配立即可以跳转
+*/
+void QuickFindBar::restart()
+{
+    key = edit->text();
+    hits.clear();
+    dictionaryHits.clear();
+    current = -1;
+    scanRow = 0;
+    scanning = false;
+    pending = NoPending;
+    scanTimer.stop();
+
+    if(!key.isEmpty() && model != nullptr) {
+        // 字典编码列按取值匹配一次，扫描时只需查位图
+        auto enhancedModel = qobject_cast<EnhancedStandardItemModel*>(model);
+        int colCount = model->columnCount();
+        for(int j = 0; enhancedModel != nullptr && j < colCount; j++) {
+            if(enhancedModel->isColumnDictionaryEncoded(j)) {
+                dictionaryHits.insert(j, enhancedModel->matchRows(j, key));
+            }
+        }
+
+        scanning = true;
+        scanTimer.start(0);
+        scanSlice();
+    }
+
+    updateLabel();
+    view->viewport()->update();
+    emit matchCountChanged(hits.size());
+}
+
+void QuickFindBar::scanSlice()
+{
+    if(!scanning || model == nullptr) {
+        scanTimer.stop();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int oldCount = hits.size();
+    int rowCount = model->rowCount();
+    QHeaderView *header = view->horizontalHeader();
+    int colCount = header->count();
+    while(scanRow < rowCount) {
+        if(!view->isRowHidden(scanRow)) {
+            for(int visual = 0; visual < colCount; visual++) {
+                int j = header->logicalIndex(visual);
+                if(view->isColumnHidden(j)) {
+                    continue;
+                }
+                bool found;
+                auto it = dictionaryHits.constFind(j);
+                if(it != dictionaryHits.constEnd()) {
+                    found = it->testBit(scanRow);
+                } else {
+                    found = cellMatches(scanRow, j);
+                }
+                if(found) {
+                    hits.append(cellKey(scanRow, visual));
+                }
+            }
+        }
+        scanRow++;
+        // 每扫描完一行检查一次耗时，避免宽表单片超时
+        if(timer.elapsed() >= sliceBudget) {
+            break;
+        }
+    }
+
+    if(scanRow >= rowCount) {
+        scanning = false;
+        scanTimer.stop();
+    }
+    if(hits.size() != oldCount || !scanning) {
+        resolvePending();
+        updateLabel();
+        view->viewport()->update();
+        emit matchCountChanged(hits.size());
+    }
+}
+
+/*
+ * 单元格内容变化时只重新检查变化的区域，保留当前匹配和未完成的跳转。
+ * 尚未扫描到的行只需更新字典位图，之后的扫描会自然处理
+*/
+void QuickFindBar::rescanRange(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                               const QVector<int> &roles)
+{
+    if(key.isEmpty() || model == nullptr || !topLeft.isValid() || topLeft.parent().isValid()) {
+        return;
+    }
+    if(!roles.isEmpty() && !roles.contains(Qt::DisplayRole) && !roles.contains(Qt::EditRole)) {
+        return;
+    }
+
+    int firstRow = topLeft.row();
+    int lastRow = bottomRight.row();
+    for(auto it = dictionaryHits.begin(); it != dictionaryHits.end(); ++it) {
+        if(it.key() < topLeft.column() || it.key() > bottomRight.column()) {
+            continue;
+        }
+        for(int i = firstRow; i <= lastRow && i < it->size(); i++) {
+            it->setBit(i, cellMatches(i, it.key()));
+        }
+    }
+
+    lastRow = qMin(lastRow, scanRow - 1);
+    if(firstRow > lastRow) {
+        return;
+    }
+
+    qint64 currentHit = current >= 0 ? hits[current] : -1;
+    QHeaderView *header = view->horizontalHeader();
+    int colCount = header->count();
+    auto begin = std::lower_bound(hits.begin(), hits.end(), cellKey(firstRow, 0));
+    auto end = std::lower_bound(hits.begin(), hits.end(), cellKey(lastRow + 1, 0));
+
+    // 保留区域内未变化列的匹配，变化的列重新检查
+    QVector<qint64> segment;
+    for(auto it = begin; it != end; ++it) {
+        int column = header->logicalIndex(static_cast<int>(*it & 0xffffffff));
+        if(column < topLeft.column() || column > bottomRight.column()) {
+            segment.append(*it);
+        }
+    }
+    for(int i = firstRow; i <= lastRow; i++) {
+        if(view->isRowHidden(i)) {
+            continue;
+        }
+        for(int j = topLeft.column(); j <= bottomRight.column() && j < colCount; j++) {
+            if(!view->isColumnHidden(j) && cellMatches(i, j)) {
+                segment.append(cellKey(i, header->visualIndex(j)));
+            }
+        }
+    }
+    std::sort(segment.begin(), segment.end());
+
+    int offset = static_cast<int>(begin - hits.begin());
+    int tail = static_cast<int>(end - hits.begin());
+    int oldCount = hits.size();
+    hits = hits.mid(0, offset) + segment + hits.mid(tail);
+
+    if(currentHit >= 0) {
+        auto it = std::lower_bound(hits.constBegin(), hits.constEnd(), currentHit);
+        current = it != hits.constEnd() && *it == currentHit ?
+                  static_cast<int>(it - hits.constBegin()) : -1;
+    }
+    resolvePending();
+    updateLabel();
+    view->viewport()->update();
+    if(hits.size() != oldCount) {
+        emit matchCountChanged(hits.size());
+    }
+}
+
+bool QuickFindBar::cellMatches(int row, int column) const
+{
+    QString data = model->data(model->index(row, column)).toString();
+    return data.contains(key, Qt::CaseInsensitive);
+}
+
+qint64 QuickFindBar::cellKey(int row, int column)
+{
+    return (static_cast<qint64>(row) << 32) | static_cast<quint32>(column);
+}
+
+qint64 QuickFindBar::currentKey() const
+{
+    QModelIndex index = view->currentIndex();
+    if(!index.isValid()) {
+        return 0;
+    }
+    return cellKey(index.row(), view->horizontalHeader()->visualIndex(index.column()));
+}
+
+// 跳转目标尚未扫描到时先记下，等扫描到或扫描结束后再跳转
+void QuickFindBar::resolvePending()
+{
+    if(pending == PendingNext) {
+        auto it = std::upper_bound(hits.constBegin(), hits.constEnd(), pendingAnchor);
+        if(it != hits.constEnd()) {
+            selectHit(static_cast<int>(it - hits.constBegin()));
+        } else if(!scanning && !hits.isEmpty()) {
+            selectHit(0);
+        } else if(scanning) {
+            return;
+        }
+    } else if(pending == PendingPrevious) {
+        auto it = std::lower_bound(hits.constBegin(), hits.constEnd(), pendingAnchor);
+        if(it != hits.constBegin()) {
+            selectHit(static_cast<int>(it - hits.constBegin()) - 1);
+        } else if(!scanning && !hits.isEmpty()) {
+            selectHit(hits.size() - 1);
+        } else if(scanning) {
+            return;
+        }
+    }
+    pending = NoPending;
+}
+
+void QuickFindBar::selectHit(int hit)
+{
+    current = hit;
+    int row = static_cast<int>(hits[hit] >> 32);
+    int visual = static_cast<int>(hits[hit] & 0xffffffff);
+    QModelIndex index = model->index(row, view->horizontalHeader()->logicalIndex(visual));
+    // 只移动当前项不改变选区，避免选中高亮盖住当前匹配的颜色
+    if(view->selectionModel() != nullptr) {
+        view->selectionModel()->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
+    }
+    view->scrollTo(index);
+    updateLabel();
+    view->viewport()->update();
+}
+
+void QuickFindBar::updateLabel()
+{
+    if(key.isEmpty()) {
+        label->clear();
+        return;
+    }
+    label->setText(QString("%1/%2%3").arg(current + 1).arg(hits.size())
+                   .arg(scanning ? "+" : ""));
+}
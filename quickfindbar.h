@@ -0,0 +1,67 @@
+#ifndef QUICKFINDBAR_H
+#define QUICKFINDBAR_H
+
+#include <QWidget>
+#include <QTableView>
+#include <QLineEdit>
+#include <QLabel>
+#include <QTimer>
+#include <QBitArray>
+#include <QPointer>
+
+class QuickFindBar: public QWidget
+{
+    Q_OBJECT
+public:
+    enum MatchState {NoMatch, Match, CurrentMatch};
+
+    QuickFindBar(QTableView *view);
+    void setModel(QAbstractItemModel *model);
+    MatchState matchState(const QModelIndex &index) const;
+    int matchCount() const;
+    bool isScanning() const;
+
+public slots:
+    void activate();
+    void dismiss();
+    void findNext();
+    void findPrevious();
+    void restart();
+
+signals:
+    void matchCountChanged(int count);
+
+private slots:
+    void scanSlice();
+    void rescanRange(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                     const QVector<int> &roles);
+
+private:
+    enum Pending {NoPending, PendingNext, PendingPrevious};
+    static const int sliceBudget = 8;
+
+    static qint64 cellKey(int row, int column);
+    bool cellMatches(int row, int column) const;
+    qint64 currentKey() const;
+    void resolvePending();
+    void selectHit(int hit);
+    void updateLabel();
+
+    QTableView *view;
+    QPointer<QAbstractItemModel> model;
+    QLineEdit *edit;
+    QLabel *label;
+    QTimer scanTimer;
+
+    QString key;
+    // 已找到的匹配位置，按行、可视列顺序排列
+    QVector<qint64> hits;
+    QHash<int, QBitArray> dictionaryHits;
+    int current = -1;
+    int scanRow = 0;
+    bool scanning = false;
+    Pending pending = NoPending;
+    qint64 pendingAnchor = -1;
+};
+
+#endif // QUICKFINDBAR_H
@@ -0,0 +1,300 @@
+#include "tableexporter.h"
+#include "enhancedstandarditemmodel.h"
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QtDebug>
+
+TableExporter::TableExporter(QAbstractItemModel *model, const QBitArray &rows,
+                             const QVector<int> &columns, QObject *parent):
+    QObject (parent), model(model), rows(rows), columns(columns)
+{
+    total = rows.count(true);
+    writer = new ExportWriter(&cancelled);
+    writer->moveToThread(&thread);
+    connect(&thread, &QThread::finished, writer, &QObject::deleteLater);
+    connect(writer, &ExportWriter::chunkWritten, this, &TableExporter::chunkWritten);
+    connect(writer, &ExportWriter::finished, this, &TableExporter::writerFinished);
+
+    // 导出过程中分多次读取模型，行列结构变化后已记录的行号不再可靠
+    if(model != nullptr) {
+        connect(model, &QAbstractItemModel::rowsInserted, this, &TableExporter::abortOnRowChange);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &TableExporter::abortOnRowChange);
+        connect(model, &QAbstractItemModel::rowsMoved, this, &TableExporter::abortOnModelChange);
+        connect(model, &QAbstractItemModel::columnsInserted, this,
+                &TableExporter::abortOnModelChange);
+        connect(model, &QAbstractItemModel::columnsRemoved, this,
+                &TableExporter::abortOnModelChange);
+        connect(model, &QAbstractItemModel::columnsMoved, this,
+                &TableExporter::abortOnModelChange);
+        connect(model, &QAbstractItemModel::layoutChanged, this,
+                &TableExporter::abortOnModelChange);
+        connect(model, &QAbstractItemModel::modelReset, this,
+                &TableExporter::abortOnModelChange);
+    }
+}
+
+TableExporter::~TableExporter()
+{
+    cancelled.storeRelease(1);
+    if(thread.isRunning()) {
+        // 导出未完成时先在工作线程中关闭并删除文件，避免留下看似完整的截断文件
+        if(!writerDone) {
+            ExportWriter *writer = this->writer;
+            QMetaObject::invokeMethod(writer, [ = ]() {
+                writer->close(true);
+            }, Qt::BlockingQueuedConnection);
+        }
+        thread.quit();
+        thread.wait();
+    } else if(!thread.isFinished()) {
+        delete writer;
+    }
+}
+
+void TableExporter::setFormat(Format format)
+{
+    this->format = format;
+}
+
+void TableExporter::setKeepHtml(bool on)
+{
+    keepHtml = on;
+}
+
+void TableExporter::start(const QString &fileName)
+{
+    // 导出进行中或已结束，不能发出finished，否则会销毁仍在运行的导出
+    if(thread.isRunning() || thread.isFinished()) {
+        qWarning() << "TableExporter::start: export already started";
+        return;
+    }
+    if(model == nullptr) {
+        fail("模型不存在");
+        return;
+    }
+
+    QStringList headers;
+    for(int col : columns) {
+        headers << model->headerData(col, Qt::Horizontal).toString();
+    }
+
+    thread.start(QThread::LowPriorityThread);
+    ExportWriter *writer = this->writer;
+    int format = this->format;
+    QMetaObject::invokeMethod(writer, [ = ]() {
+        writer->open(fileName, format, headers);
+    });
+    fetchChunks();
+}
+
+// 未能启动导出时通过finished异步通知，调用方仍可在返回后连接信号
+void TableExporter::fail(const QString &errorString)
+{
+    QMetaObject::invokeMethod(this, [ = ]() {
+        emit finished(false, errorString);
+    }, Qt::QueuedConnection);
+}
+
+void TableExporter::abortOnModelChange()
+{
+    if(closing || !thread.isRunning()) {
+        return;
+    }
+    abortReason = "导出过程中表格结构发生变化";
+    cancel();
+}
+
+// 追加在快照末尾之后的行不影响已记录的行号，导出可以继续
+void TableExporter::abortOnRowChange(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(last)
+    if(parent.isValid() || first >= rows.size()) {
+        return;
+    }
+    abortOnModelChange();
+}
+
+void TableExporter::cancel()
+{
+    if(closing || !thread.isRunning()) {
+        return;
+    }
+
+    cancelled.storeRelease(1);
+    closing = true;
+    ExportWriter *writer = this->writer;
+    QMetaObject::invokeMethod(writer, [ = ]() {
+        writer->close(true);
+    });
+}
+
+/*
+ * 模型只能在GUI线程读取：每次最多读取maxPendingChunks个块交给工作线程，
+ * 写完一块再读下一块，内存占用与导出的总行数无关
+*/
+void TableExporter::fetchChunks()
+{
+    if(closing) {
+        return;
+    }
+    if(cancelled.loadAcquire() != 0 || model == nullptr) {
+        cancelled.storeRelease(1);
+        closing = true;
+        ExportWriter *writer = this->writer;
+        QMetaObject::invokeMethod(writer, [ = ]() {
+            writer->close(true);
+        });
+        return;
+    }
+
+    int rowCount = rows.size();
+    while(pendingChunks < maxPendingChunks && nextRow < rowCount) {
+        QVector<QStringList> chunk;
+        chunk.reserve(chunkRows);
+        for(; chunk.size() < chunkRows && nextRow < rowCount; nextRow++) {
+            if(!rows.testBit(nextRow)) {
+                continue;
+            }
+            QStringList values;
+            for(int col : columns) {
+                QModelIndex index = model->index(nextRow, col);
+                QVariant html;
+                if(keepHtml) {
+                    html = model->data(index, EnhancedStandardItemModel::HtmlRole);
+                }
+                values << (html.isValid() ? html.toString() : model->data(index).toString());
+            }
+            chunk.append(values);
+        }
+        if(chunk.isEmpty()) {
+            break;
+        }
+
+        pendingChunks++;
+        ExportWriter *writer = this->writer;
+        QMetaObject::invokeMethod(writer, [ = ]() {
+            writer->writeChunk(chunk);
+        });
+    }
+
+    if(nextRow >= rowCount && pendingChunks == 0) {
+        closing = true;
+        ExportWriter *writer = this->writer;
+        QMetaObject::invokeMethod(writer, [ = ]() {
+            writer->close(false);
+        });
+    }
+}
+
+void TableExporter::chunkWritten(int rows)
+{
+    pendingChunks--;
+    written += rows;
+    emit progress(written, total);
+    fetchChunks();
+}
+
+void TableExporter::writerFinished(bool success, QString errorString)
+{
+    writerDone = true;
+    thread.quit();
+    if(!abortReason.isEmpty()) {
+        emit finished(false, abortReason);
+        return;
+    }
+    emit finished(success, errorString);
+}
+
+ExportWriter::ExportWriter(QAtomicInt *cancelled): cancelled(cancelled)
+{}
+
+void ExportWriter::open(const QString &fileName, int format, const QStringList &headers)
+{
+    this->format = format;
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString = file.errorString();
+        cancelled->storeRelease(1);
+        return;
+    }
+
+    // JSON Lines以表头作为键，空表头或重复表头改用列序号区分
+    for(int i = 0; i < headers.count(); i++) {
+        QString key = headers[i].isEmpty() ? QString::number(i + 1) : headers[i];
+        while(keys.contains(key)) {
+            key = QString("%1_%2").arg(key).arg(i + 1);
+        }
+        keys << key;
+    }
+
+    if(format != TableExporter::JsonLines) {
+        QByteArray data = formatRow(headers);
+        if(file.write(data) != data.size()) {
+            errorString = file.errorString();
+            cancelled->storeRelease(1);
+        }
+    }
+}
+
+void ExportWriter::writeChunk(const QVector<QStringList> &chunk)
+{
+    // 跳过的块也要回报，以便导出方释放待写计数，但不计入已写行数
+    int written = 0;
+    if(cancelled->loadAcquire() == 0 && file.isOpen()) {
+        QByteArray data;
+        for(const QStringList &row : chunk) {
+            data.append(formatRow(row));
+        }
+        if(file.write(data) != data.size()) {
+            errorString = file.errorString();
+            cancelled->storeRelease(1);
+        } else {
+            written = chunk.size();
+        }
+    }
+    emit chunkWritten(written);
+}
+
+void ExportWriter::close(bool remove)
+{
+    // 只删除本次打开过的文件，打开失败时不能误删已有文件
+    bool opened = file.isOpen();
+    if(opened) {
+        file.close();
+    }
+    if(remove && opened) {
+        file.remove();
+    }
+
+    if(!errorString.isEmpty()) {
+        emit finished(false, errorString);
+    } else if(remove) {
+        emit finished(false, "导出已取消");
+    } else {
+        emit finished(true, QString());
+    }
+}
+
+QByteArray ExportWriter::formatRow(const QStringList &row) const
+{
+    if(format == TableExporter::JsonLines) {
+        QJsonObject object;
+        for(int i = 0; i < row.count() && i < keys.count(); i++) {
+            object.insert(keys[i], row[i]);
+        }
+        return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+    }
+
+    QStringList fields;
+    for(QString field : row) {
+        if(format == TableExporter::Tsv) {
+            field.replace('\t', ' ').replace('\n', ' ').replace('\r', ' ');
+        } else if(field.contains(',') || field.contains('"') ||
+                  field.contains('\n') || field.contains('\r')) {
+            field = QString("\"%1\"").arg(field.replace('"', "\"\""));
+        }
+        fields << field;
+    }
+    QString separator = format == TableExporter::Tsv ? "\t" : ",";
+    return (fields.join(separator) + '\n').toUtf8();
+}
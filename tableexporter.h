@@ -0,0 +1,89 @@
+#ifndef TABLEEXPORTER_H
+#define TABLEEXPORTER_H
+
+#include <QObject>
+#include <QAbstractItemModel>
+#include <QBitArray>
+#include <QPointer>
+#include <QAtomicInt>
+#include <QFile>
+#include <QThread>
+
+class ExportWriter;
+
+class TableExporter: public QObject
+{
+    Q_OBJECT
+public:
+    enum Format {Csv, Tsv, JsonLines};
+
+    TableExporter(QAbstractItemModel *model, const QBitArray &rows,
+                  const QVector<int> &columns, QObject *parent = nullptr);
+    ~TableExporter();
+    void setFormat(Format format);
+    void setKeepHtml(bool on);
+    void start(const QString &fileName);
+    void cancel();
+
+signals:
+    void progress(qint64 written, qint64 total);
+    void finished(bool success, QString errorString);
+
+private slots:
+    void fetchChunks();
+    void chunkWritten(int rows);
+    void writerFinished(bool success, QString errorString);
+    void abortOnModelChange();
+    void abortOnRowChange(const QModelIndex &parent, int first, int last);
+
+private:
+    void fail(const QString &errorString);
+
+    static const int chunkRows = 1000;
+    static const int maxPendingChunks = 4;
+
+    QPointer<QAbstractItemModel> model;
+    QBitArray rows;
+    QVector<int> columns;
+    Format format = Csv;
+    bool keepHtml = false;
+
+    QThread thread;
+    ExportWriter *writer = nullptr;
+    QAtomicInt cancelled;
+    int nextRow = 0;
+    int pendingChunks = 0;
+    qint64 written = 0;
+    qint64 total = 0;
+    bool closing = false;
+    bool writerDone = false;
+    QString abortReason;
+};
+
+// 在工作线程中格式化并写入文件
+class ExportWriter: public QObject
+{
+    Q_OBJECT
+public:
+    ExportWriter(QAtomicInt *cancelled);
+
+public slots:
+    void open(const QString &fileName, int format, const QStringList &headers);
+    void writeChunk(const QVector<QStringList> &chunk);
+    void close(bool remove);
+
+signals:
+    void chunkWritten(int rows);
+    void finished(bool success, QString errorString);
+
+private:
+    QByteArray formatRow(const QStringList &row) const;
+
+    QAtomicInt *cancelled;
+    QFile file;
+    int format = TableExporter::Csv;
+    QStringList keys;
+    QString errorString;
+};
+
+#endif // TABLEEXPORTER_H